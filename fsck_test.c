@@ -0,0 +1,91 @@
+/* fsck_test.c
+ *   reproducible check for jfs_fsck: builds a small file system on a fresh DISK
+ *   file, corrupts the free-space map with one orphan block and one reachable
+ *   block that is marked free, and then checks that jfs_fsck(0) reports both,
+ *   jfs_fsck(1) repairs them and a second jfs_fsck(0) reports nothing; then
+ *   checks that a rebuild leaves the free-space map alone when the root, or a
+ *   directory below it, has a block type fsck cannot walk.
+ * usage: fsck_test DISK   (DISK has to be a freshly formatted disk file)
+ * build together with jumbo_file_system.c, jfs_transfer.c and the disk layer,
+ *   linking with -pthread
+ */
+#include "jfs_tools.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// helper function that prints a failed step and exits
+static void check(int ok, const char *what) {
+  if(!ok){
+    fprintf(stderr, "fsck_test: FAILED: %s\n", what);
+    exit(1);
+  }
+  printf("fsck_test: ok: %s\n", what);
+}
+
+
+int main(int argc, char **argv) {
+  if(argc != 2){
+    fprintf(stderr, "usage: %s DISK\n", argv[0]);
+    return 2;
+  }
+  check(jfs_mount(argv[1]) == 0, "mount");
+  //a small tree: a subdirectory holding a file with a few data blocks
+  char data[3 * BLOCK_SIZE];
+  memset(data, 'x', sizeof(data));
+  check(jfs_mkdir("dir") == E_SUCCESS, "mkdir dir");
+  check(jfs_chdir("dir") == E_SUCCESS, "chdir dir");
+  check(jfs_creat("file") == E_SUCCESS, "creat file");
+  check(jfs_write("file", data, sizeof(data)) == E_SUCCESS, "write file");
+  check(jfs_fsck(0) == 0, "fsck of the untouched file system finds nothing");
+
+  //corruption 1: a block that is allocated but that nothing points to
+  block_num_t orphan = allocate_block();
+  check(orphan != 0, "allocate an orphan block");
+  //corruption 2: a data block of the file that is marked free
+  struct stats st;
+  check(jfs_stat("file", &st) == E_SUCCESS, "stat file");
+  void *buffer = malloc(BLOCK_SIZE);
+  read_block(st.block_num, buffer);
+  block_num_t data_block = ((struct block *) buffer)->contents.inode.data_blocks[1];
+  free(buffer);
+  release_block(data_block);
+
+  check(jfs_fsck(0) == 2, "fsck finds the orphan and the free data block");
+  check(jfs_fsck(0) == 2, "a check-only fsck leaves the free-space map as it was");
+  check(jfs_fsck(1) == 2, "fsck with rebuild reports the same two problems");
+  check(jfs_fsck(0) == 0, "fsck after the rebuild finds nothing");
+
+  //the rebuilt map must never hand out the data block again
+  block_num_t new_block = allocate_block();
+  check(new_block != data_block, "the data block stays allocated");
+  release_block(new_block);
+
+  //corruption 3: a root that is not a dir node; nothing is reachable then, so a
+  //rebuild must leave the free-space map alone instead of releasing every block
+  struct block *block1 = malloc(BLOCK_SIZE);
+  read_block(1, block1);
+  int saved = block1->is_dir;
+  block1->is_dir = 7;
+  write_block(1, block1);
+  check(jfs_fsck(1) > 0, "fsck with rebuild reports a root that is not a directory");
+  block1->is_dir = saved;
+  write_block(1, block1);
+  check(jfs_fsck(0) == 0, "the rebuild left the free-space map alone for a broken root");
+
+  //corruption 4: a subdirectory of unknown type; the file below it must not be released as an orphan
+  check(jfs_chdir(NULL) == E_SUCCESS, "chdir to the root");
+  check(jfs_stat("dir", &st) == E_SUCCESS, "stat dir");
+  read_block(st.block_num, block1);
+  saved = block1->is_dir;
+  block1->is_dir = 7;
+  write_block(st.block_num, block1);
+  check(jfs_fsck(1) > 0, "fsck with rebuild reports a block of unknown type");
+  block1->is_dir = saved;
+  write_block(st.block_num, block1);
+  check(jfs_fsck(0) == 0, "the rebuild left the free-space map alone for a block of unknown type");
+  free(block1);
+  check(jfs_unmount() == 0, "unmount");
+  return 0;
+}
@@ -0,0 +1,46 @@
+#ifndef JFS_INTERNAL_H
+#define JFS_INTERNAL_H
+
+#include "jumbo_file_system.h"
+
+/* declarations shared between jumbo_file_system.c and the tools built on it;
+ * not part of the jfs_* API
+ */
+
+// C does not have a bool type, so I created one that you can use
+typedef char bool_t;
+#define TRUE 1
+#define FALSE 0
+
+/* jfs_current_dir
+ *   returns the block number of the current directory
+ */
+block_num_t jfs_current_dir(void);
+
+/* consistency checks shared by jfs_fsck and jfs_export; each one reports
+ * what it finds on stderr, prefixed with who, and returns the number of
+ * problems found (0 if the checked part is fine)
+ */
+
+// the number of entries of the dir node dir is within MAX_DIR_ENTRIES
+int jfs_check_num_entries(const char *who, block_num_t dir, const struct block *block);
+
+// the name of entry i of the dir node dir is non empty, null terminated and not a duplicate of an earlier entry
+int jfs_check_entry_name(const char *who, block_num_t dir, const struct block *block, int i);
+
+// entry i of the dir node dir points to a block in range
+int jfs_check_entry_block(const char *who, block_num_t dir, const struct block *block, int i);
+
+// the block is a dir node or an inode
+int jfs_check_block_type(const char *who, block_num_t block_num, const struct block *block);
+
+// the file_size of the inode is within MAX_FILE_SIZE and all of its data blocks are in range
+int jfs_check_inode(const char *who, block_num_t file, const struct block *block);
+
+/* jfs_inode_data_blocks
+ *   returns the number of data blocks the inode uses, following from its
+ *   file_size (capped at MAX_FILE_SIZE)
+ */
+uint32_t jfs_inode_data_blocks(const struct block *block);
+
+#endif
@@ -0,0 +1,93 @@
+/* jfs_tool.c
+ *   command line driver for the whole-file-system tools, e.g. to build or check
+ *   disk images in CI:
+ *     jfs_tool DISK import HOST_DIR   copies HOST_DIR into the root directory
+ *     jfs_tool DISK export HOST_DIR   copies the root directory out to HOST_DIR
+ *     jfs_tool DISK fsck [--rebuild]  checks DISK, rebuilding the free-space map if asked
+ *   import and export print the throughput; the exit status is 0 on success and
+ *   1 on any error (for fsck without --rebuild, also when problems were found)
+ * build together with jumbo_file_system.c, jfs_transfer.c and the disk layer,
+ *   linking with -pthread
+ */
+#include "jfs_tools.h"
+#include <stdio.h>
+#include <string.h>
+
+
+// helper function that prints the throughput line for import and export
+static void print_transfer(const char *what, const struct jfs_transfer_stats *stats) {
+  double mb = stats->bytes / (1024.0 * 1024.0);
+  double seconds = stats->seconds > 0 ? stats->seconds : 1e-9;
+  printf("%s: %u files, %u dirs, %.2f MB in %.3f s (%.2f MB/s, %.1f files/s)\n",
+         what, (unsigned) stats->files, (unsigned) stats->dirs, mb, stats->seconds,
+         mb / seconds, stats->files / seconds);
+}
+
+
+static int usage(const char *prog) {
+  fprintf(stderr, "usage: %s DISK import HOST_DIR\n", prog);
+  fprintf(stderr, "       %s DISK export HOST_DIR\n", prog);
+  fprintf(stderr, "       %s DISK fsck [--rebuild]\n", prog);
+  return 1;
+}
+
+
+int main(int argc, char **argv) {
+  if(argc < 3){
+    return usage(argv[0]);
+  }
+  const char *command = argv[2];
+  int is_import = strcmp(command, "import") == 0;
+  int is_export = strcmp(command, "export") == 0;
+  int is_fsck = strcmp(command, "fsck") == 0;
+  int rebuild = 0;
+  if((is_import || is_export) && argc != 4){
+    return usage(argv[0]);
+  }
+  if(is_fsck){
+    if(argc == 4 && strcmp(argv[3], "--rebuild") == 0){
+      rebuild = 1;
+    }else if(argc != 3){
+      return usage(argv[0]);
+    }
+  }
+  if(!is_import && !is_export && !is_fsck){
+    return usage(argv[0]);
+  }
+  if(jfs_mount(argv[1]) != 0){
+    fprintf(stderr, "%s: cannot mount %s\n", argv[0], argv[1]);
+    return 1;
+  }
+  int failed = 0;
+  struct jfs_transfer_stats stats;
+  if(is_import){
+    int ret = jfs_import(argv[3], &stats);
+    print_transfer("import", &stats);
+    if(ret != E_SUCCESS){
+      fprintf(stderr, "%s: import of %s failed with %d\n", argv[0], argv[3], ret);
+      failed = 1;
+    }
+  }else if(is_export){
+    int ret = jfs_export(argv[3], &stats);
+    print_transfer("export", &stats);
+    if(ret != E_SUCCESS){
+      fprintf(stderr, "%s: export to %s failed\n", argv[0], argv[3]);
+      failed = 1;
+    }
+  }else{
+    int problems = jfs_fsck(rebuild);
+    if(problems < 0){
+      fprintf(stderr, "%s: fsck failed\n", argv[0]);
+      failed = 1;
+    }else{
+      printf("fsck: %d problems found%s\n", problems, rebuild && problems > 0 ? ", free-space map rebuilt" : "");
+      if(problems > 0 && !rebuild){
+        failed = 1;
+      }
+    }
+  }
+  if(jfs_unmount() != 0){
+    failed = 1;
+  }
+  return failed;
+}
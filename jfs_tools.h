@@ -0,0 +1,36 @@
+#ifndef JFS_TOOLS_H
+#define JFS_TOOLS_H
+
+#include "jumbo_file_system.h"
+
+/* whole-file-system tools built on top of the jfs_* API in jumbo_file_system.h;
+ * see jumbo_file_system.c for the full description of each function
+ */
+
+/* jfs_fsck
+ *   checks the whole file system and, if rebuild is nonzero, rebuilds the
+ *   free-space map; returns the number of problems found or -1 on error
+ */
+int jfs_fsck(int rebuild);
+
+/* counters filled in by jfs_import and jfs_export */
+struct jfs_transfer_stats {
+  uint32_t files;
+  uint32_t dirs;
+  uint64_t bytes;
+  double seconds;
+};
+
+/* jfs_import
+ *   copies the host directory tree at host_path into the current directory;
+ *   returns 0 on success, -1 on a host error or one of the E_* error codes
+ */
+int jfs_import(const char* host_path, struct jfs_transfer_stats* stats);
+
+/* jfs_export
+ *   copies the current directory tree out to host_path on the host;
+ *   returns 0 on success or -1 on error
+ */
+int jfs_export(const char* host_path, struct jfs_transfer_stats* stats);
+
+#endif
@@ -0,0 +1,643 @@
+/* jfs_transfer.c
+ *   bulk copy between a directory tree on the _real_ file system and the
+ *   current directory of the jumbo file system (jfs_import, jfs_export); kept
+ *   apart from jumbo_file_system.c because it needs the host's directory,
+ *   stat and thread APIs
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "jumbo_file_system.h"
+#include "jfs_tools.h"
+#include "jfs_internal.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+
+// number of threads that read host files for jfs_import, and how many files they may read ahead
+#define IMPORT_READERS 4
+#define IMPORT_QUEUE_DEPTH 16
+
+// states of a read-ahead slot in the import queue
+#define SLOT_EMPTY 0
+#define SLOT_READY 1
+#define SLOT_FAILED 2
+
+
+// one host file or directory that jfs_import is going to copy in
+struct import_item {
+  char *path; //malloced host path
+  char name[MAX_NAME_LENGTH + 1];
+  bool_t is_dir;
+  uint32_t file_size;
+  uint32_t file_index; //for files: position in the order the readers read them
+  uint32_t first_child; //for directories: the children are items first_child .. first_child + num_children - 1
+  uint32_t num_children;
+  block_num_t block_num; //the block the item got in the image, 0 until then
+};
+
+
+// the whole host tree, scanned before anything is written to the image
+struct import_plan {
+  struct import_item *items;
+  uint32_t num_items;
+  uint32_t max_items;
+  uint32_t *files; //item index of every file, in read order
+  uint32_t num_files;
+};
+
+
+// the read-ahead queue between the reader threads and the thread writing the image;
+// file j is read into slots[j % IMPORT_QUEUE_DEPTH] once the writer is done with file j - IMPORT_QUEUE_DEPTH
+struct import_queue {
+  struct import_plan *plan;
+  char *slots[IMPORT_QUEUE_DEPTH];
+  int status[IMPORT_QUEUE_DEPTH];
+  uint32_t next_read; //next file a reader picks up
+  uint32_t consumed; //number of files the writer is done with
+  bool_t stop;
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+};
+
+
+// helper function that joins a host directory path and an entry name into a malloced path
+static char *join_path(const char *dir, const char *name) {
+  char *path = malloc(strlen(dir) + strlen(name) + 2);
+  if(path != NULL){
+    sprintf(path, "%s/%s", dir, name);
+  }
+  return path;
+}
+
+
+// helper function that gives the time in seconds from a monotonic clock
+static double now_seconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+// helper function for jfs_import that adds one item to the plan and returns its index, or -1
+static int64_t plan_add(struct import_plan *plan) {
+  if(plan->num_items == plan->max_items){
+    uint32_t max_items = plan->max_items == 0 ? 64 : plan->max_items * 2;
+    struct import_item *items = realloc(plan->items, max_items * sizeof(struct import_item));
+    if(items == NULL){
+      return -1;
+    }
+    plan->items = items;
+    plan->max_items = max_items;
+  }
+  memset(&plan->items[plan->num_items], 0, sizeof(struct import_item));
+  plan->num_items += 1;
+  return plan->num_items - 1;
+}
+
+
+// helper function for jfs_import that lists one host directory into the plan: all of its
+// entries are added next to each other first, then its subdirectories are listed in order,
+// which is also the order the writer visits them in, so files are used in the order they are read
+static int plan_dir(struct import_plan *plan, const char *host_path, uint32_t *first_child, uint32_t *num_children) {
+  DIR *host_dir = opendir(host_path);
+  if(host_dir == NULL){
+    return -1;
+  }
+  *first_child = plan->num_items;
+  *num_children = 0;
+  int ret = E_SUCCESS;
+  struct dirent *host_entry;
+  while(ret == E_SUCCESS && (host_entry = readdir(host_dir)) != NULL){
+    const char *name = host_entry->d_name;
+    if(strcmp(name, ".") == 0 || strcmp(name, "..") == 0){
+      continue;
+    }
+    char *path = join_path(host_path, name);
+    struct stat st;
+    //lstat so symbolic links are seen as links and skipped instead of followed
+    if(path == NULL || lstat(path, &st) != 0){
+      free(path);
+      ret = -1;
+      break;
+    }
+    //only directories and regular files can be stored in the image
+    if(!S_ISDIR(st.st_mode) && !S_ISREG(st.st_mode)){
+      free(path);
+      continue;
+    }
+    if(strlen(name) > MAX_NAME_LENGTH){
+      ret = E_MAX_NAME_LENGTH;
+    }else if(*num_children == MAX_DIR_ENTRIES){
+      ret = E_MAX_DIR_ENTRIES;
+    }else if(S_ISREG(st.st_mode) && (st.st_size < 0 || (uint64_t) st.st_size > MAX_FILE_SIZE)){
+      ret = E_MAX_FILE_SIZE;
+    }
+    int64_t index = ret == E_SUCCESS ? plan_add(plan) : -1;
+    if(ret == E_SUCCESS && index < 0){
+      ret = -1;
+    }
+    if(ret != E_SUCCESS){
+      free(path);
+      break;
+    }
+    struct import_item *item = &plan->items[index];
+    item->path = path;
+    strncpy(item->name, name, strlen(name) + 1);
+    item->is_dir = S_ISDIR(st.st_mode) ? TRUE : FALSE;
+    item->file_size = item->is_dir ? 0 : (uint32_t) st.st_size;
+    *num_children += 1;
+  }
+  closedir(host_dir);
+  for(uint32_t i = *first_child; ret == E_SUCCESS && i < *first_child + *num_children; i++){
+    if(plan->items[i].is_dir){
+      //plan_dir may move the items, so the child range is written through the index only afterwards
+      uint32_t first = 0;
+      uint32_t count = 0;
+      ret = plan_dir(plan, plan->items[i].path, &first, &count);
+      plan->items[i].first_child = first;
+      plan->items[i].num_children = count;
+    }
+  }
+  return ret;
+}
+
+
+// helper function for jfs_import that checks the top level of the plan against the entries
+// already in the target dir node dir, so that name clashes and overflowing it are found
+// before anything is written
+static int plan_check_target(const struct import_plan *plan, block_num_t dir, uint32_t first, uint32_t count) {
+  void *buffer1 = malloc(BLOCK_SIZE);
+  if(buffer1 == NULL){
+    return -1;
+  }
+  read_block(dir, buffer1);
+  struct block *block1 = (struct block *) buffer1;
+  uint16_t num_entries1 = (*block1).contents.dirnode.num_entries;
+  int ret = E_SUCCESS;
+  if(num_entries1 + count > MAX_DIR_ENTRIES){
+    ret = E_MAX_DIR_ENTRIES;
+  }
+  for(uint32_t k = first; ret == E_SUCCESS && k < first + count; k++){
+    for(int i = 0; i < num_entries1; i++){
+      if(strcmp(plan->items[k].name, (*block1).contents.dirnode.entries[i].name) == 0){
+        ret = E_EXISTS;
+        break;
+      }
+    }
+  }
+  free(buffer1);
+  return ret;
+}
+
+
+// helper function for jfs_import that frees everything in the plan
+static void plan_free(struct import_plan *plan) {
+  for(uint32_t i = 0; i < plan->num_items; i++){
+    free(plan->items[i].path);
+  }
+  free(plan->items);
+  free(plan->files);
+}
+
+
+// reader thread of jfs_import: takes the next file that has a free slot and reads it in
+// with a single call; the host reads never touch the disk layer
+static void *import_reader(void *arg) {
+  struct import_queue *queue = (struct import_queue *) arg;
+  pthread_mutex_lock(&queue->lock);
+  while(!queue->stop && queue->next_read < queue->plan->num_files){
+    uint32_t j = queue->next_read;
+    //wait until the writer is done with the file that used this slot before
+    if(j >= queue->consumed + IMPORT_QUEUE_DEPTH){
+      pthread_cond_wait(&queue->changed, &queue->lock);
+      continue;
+    }
+    queue->next_read += 1;
+    pthread_mutex_unlock(&queue->lock);
+    struct import_item *item = &queue->plan->items[queue->plan->files[j]];
+    char *slot = queue->slots[j % IMPORT_QUEUE_DEPTH];
+    int status = SLOT_FAILED;
+    FILE *host_file = fopen(item->path, "rb");
+    if(host_file != NULL){
+      if(fread(slot, 1, item->file_size, host_file) == item->file_size){
+        status = SLOT_READY;
+      }
+      fclose(host_file);
+    }
+    //the rest of the last block is padded the same way jfs_write does
+    if(item->file_size % BLOCK_SIZE != 0){
+      memset(slot + item->file_size, -1, BLOCK_SIZE - item->file_size % BLOCK_SIZE);
+    }
+    pthread_mutex_lock(&queue->lock);
+    queue->status[j % IMPORT_QUEUE_DEPTH] = status;
+    pthread_cond_broadcast(&queue->changed);
+  }
+  pthread_mutex_unlock(&queue->lock);
+  return NULL;
+}
+
+
+// helper function for jfs_import that waits for file j to be read and gives its data, or NULL if the read failed
+static char *queue_take(struct import_queue *queue, uint32_t j) {
+  pthread_mutex_lock(&queue->lock);
+  while(queue->status[j % IMPORT_QUEUE_DEPTH] == SLOT_EMPTY){
+    pthread_cond_wait(&queue->changed, &queue->lock);
+  }
+  int status = queue->status[j % IMPORT_QUEUE_DEPTH];
+  pthread_mutex_unlock(&queue->lock);
+  if(status == SLOT_FAILED){
+    return NULL;
+  }
+  return queue->slots[j % IMPORT_QUEUE_DEPTH];
+}
+
+
+// helper function for jfs_import that hands the slot of file j back to the readers
+static void queue_done(struct import_queue *queue, uint32_t j) {
+  pthread_mutex_lock(&queue->lock);
+  queue->status[j % IMPORT_QUEUE_DEPTH] = SLOT_EMPTY;
+  queue->consumed = j + 1;
+  pthread_cond_broadcast(&queue->changed);
+  pthread_mutex_unlock(&queue->lock);
+}
+
+
+// helper function for jfs_import that stores one file that was already read into data
+// as a new inode and returns the inode block through file, or an error code
+static int store_file(const char *data, uint32_t file_size, block_num_t *file, struct jfs_transfer_stats *stats) {
+  uint32_t data_blocks = file_size / BLOCK_SIZE;
+  if(file_size % BLOCK_SIZE != 0){
+    data_blocks += 1;
+  }
+  //allocate the inode and all of its data blocks in one go, so a first fit
+  //allocator hands out one contiguous run instead of one block per append
+  block_num_t new_block[MAX_DATA_BLOCKS + 1];
+  for(uint32_t i = 0; i <= data_blocks; i++){
+    new_block[i] = allocate_block();
+    if(new_block[i] == 0){
+      //give back whatever we got before running out of space
+      while(i > 0){
+        i -= 1;
+        release_block(new_block[i]);
+      }
+      return E_DISK_FULL;
+    }
+  }
+  //write the data first so the inode never points at blocks that were not written yet
+  for(uint32_t i = 0; i < data_blocks; i++){
+    write_block(new_block[i + 1], data + (size_t) i * BLOCK_SIZE);
+  }
+  void *buffer2 = calloc(1, BLOCK_SIZE);
+  if(buffer2 == NULL){
+    for(uint32_t i = 0; i <= data_blocks; i++){
+      release_block(new_block[i]);
+    }
+    return -1;
+  }
+  struct block *block2 = (struct block *) buffer2;
+  (*block2).is_dir = 1; //we are setting the is_dir to 1 as this is a file
+  (*block2).contents.inode.file_size = file_size;
+  for(uint32_t i = 0; i < data_blocks; i++){
+    (*block2).contents.inode.data_blocks[i] = new_block[i + 1];
+  }
+  write_block(new_block[0], buffer2);
+  free(buffer2);
+  *file = new_block[0];
+  stats->files += 1;
+  stats->bytes += file_size;
+  return E_SUCCESS;
+}
+
+
+// helper function for jfs_import that copies the planned children first .. first + count - 1
+// into the dir node dir, writes the dir node once, and then fills in the new subdirectories
+static int write_dir(struct import_plan *plan, struct import_queue *queue, block_num_t dir,
+                     uint32_t first, uint32_t count, struct jfs_transfer_stats *stats) {
+  void *buffer1 = malloc(BLOCK_SIZE);
+  if(buffer1 == NULL){
+    return -1;
+  }
+  read_block(dir, buffer1);
+  struct block *block1 = (struct block *) buffer1;
+  uint16_t *num_entries1 = &((*block1).contents.dirnode.num_entries);
+  int ret = E_SUCCESS;
+  for(uint32_t k = first; ret == E_SUCCESS && k < first + count; k++){
+    struct import_item *item = &plan->items[k];
+    //same checks as jfs_mkdir and jfs_creat; jfs_import already made them against the target
+    //directory before writing anything, so they only guard against a dir node changed since
+    if(*num_entries1 == MAX_DIR_ENTRIES){
+      ret = E_MAX_DIR_ENTRIES;
+      break;
+    }
+    for(int i = 0; i < *num_entries1; i++){
+      if(strcmp(item->name, (*block1).contents.dirnode.entries[i].name) == 0){
+        ret = E_EXISTS;
+        break;
+      }
+    }
+    if(ret != E_SUCCESS){
+      break;
+    }
+    block_num_t new_block = 0;
+    if(item->is_dir){
+      new_block = allocate_block();
+      void *buffer2 = calloc(1, BLOCK_SIZE);
+      if(new_block == 0){
+        free(buffer2);
+        ret = E_DISK_FULL;
+      }else if(buffer2 == NULL){
+        release_block(new_block);
+        new_block = 0;
+        ret = -1;
+      }else{
+        //an empty dir node for the subdirectory, filled in further down
+        struct block *block2 = (struct block *) buffer2;
+        (*block2).is_dir = 0;
+        (*block2).contents.dirnode.num_entries = 0;
+        write_block(new_block, buffer2);
+        free(buffer2);
+        stats->dirs += 1;
+      }
+    }else{
+      char *data = queue_take(queue, item->file_index);
+      if(data == NULL){
+        ret = -1;
+      }else{
+        ret = store_file(data, item->file_size, &new_block, stats);
+      }
+      queue_done(queue, item->file_index);
+    }
+    if(new_block != 0){
+      item->block_num = new_block;
+      *num_entries1 += 1;
+      (*block1).contents.dirnode.entries[(*num_entries1) - 1].block_num = new_block;
+      strncpy((*block1).contents.dirnode.entries[(*num_entries1) - 1].name, item->name, strlen(item->name) + 1);
+    }
+  }
+  //everything added before an error is kept, so the image stays consistent
+  write_block(dir, buffer1);
+  free(buffer1);
+  for(uint32_t k = first; ret == E_SUCCESS && k < first + count; k++){
+    struct import_item *item = &plan->items[k];
+    if(item->is_dir){
+      ret = write_dir(plan, queue, item->block_num, item->first_child, item->num_children, stats);
+    }
+  }
+  return ret;
+}
+
+
+// helper function for jfs_export that tells if an entry name that passed jfs_check_entry_name
+// is also safe to use as a single host path component (not . or .., no /)
+static bool_t safe_host_name(const char *name) {
+  if(name[0] == '\0' || strcmp(name, ".") == 0 || strcmp(name, "..") == 0 || strchr(name, '/') != NULL){
+    return FALSE;
+  }
+  return TRUE;
+}
+
+
+// helper function for jfs_export that creates a host directory below host_path; one that
+// already exists is only used if it is a real directory, never a symbolic link to somewhere else
+static int make_host_dir(const char *path) {
+  if(mkdir(path, 0755) == 0){
+    return E_SUCCESS;
+  }
+  struct stat st;
+  if(errno == EEXIST && lstat(path, &st) == 0 && S_ISDIR(st.st_mode)){
+    return E_SUCCESS;
+  }
+  return -1;
+}
+
+
+// helper function for jfs_export that writes the dir node dir out as the host directory host_path;
+// buffer3 holds one file of the largest possible size and visited marks the dir nodes already exported
+static int export_dir(block_num_t dir, const char *host_path, char *buffer3, unsigned char *visited,
+                      struct jfs_transfer_stats *stats) {
+  void *buffer1 = malloc(BLOCK_SIZE);
+  void *buffer2 = malloc(BLOCK_SIZE);
+  if(buffer1 == NULL || buffer2 == NULL){
+    free(buffer1);
+    free(buffer2);
+    return -1;
+  }
+  read_block(dir, buffer1);
+  struct block *block1 = (struct block *) buffer1;
+  struct block *block2 = (struct block *) buffer2;
+  uint16_t num_entries1 = (*block1).contents.dirnode.num_entries;
+  int ret = E_SUCCESS;
+  //the image may be damaged, so everything read from it goes through the checks jfs_fsck uses
+  if(jfs_check_num_entries("jfs_export", dir, block1) != 0){
+    ret = -1;
+  }
+  for(int i = 0; ret == E_SUCCESS && i < num_entries1; i++){
+    const char *name = (*block1).contents.dirnode.entries[i].name;
+    block_num_t child = (*block1).contents.dirnode.entries[i].block_num;
+    if(jfs_check_entry_name("jfs_export", dir, block1, i) != 0 || jfs_check_entry_block("jfs_export", dir, block1, i) != 0){
+      ret = -1;
+      break;
+    }
+    //on top of that, the name must stay inside host_path
+    if(!safe_host_name(name)){
+      fprintf(stderr, "jfs_export: dir %u: entry %d has a name that is not a valid host file name\n", (unsigned) dir, i);
+      ret = -1;
+      break;
+    }
+    read_block(child, buffer2);
+    if(jfs_check_block_type("jfs_export", child, block2) != 0){
+      ret = -1;
+      break;
+    }
+    char *path = join_path(host_path, name);
+    if(path == NULL){
+      ret = -1;
+      break;
+    }
+    if((*block2).is_dir == 0){
+      //a dir node that was exported already means the tree has a cycle
+      if(visited[child]){
+        fprintf(stderr, "jfs_export: dir %u: entry %s leads back to dir %u\n", (unsigned) dir, name, (unsigned) child);
+        ret = -1;
+      }else{
+        visited[child] = TRUE;
+        ret = make_host_dir(path);
+        if(ret == E_SUCCESS){
+          stats->dirs += 1;
+          ret = export_dir(child, path, buffer3, visited, stats);
+        }
+      }
+    }else if(jfs_check_inode("jfs_export", child, block2) != 0){
+      ret = -1;
+    }else{
+      uint32_t file_size = (*block2).contents.inode.file_size;
+      uint32_t data_blocks = jfs_inode_data_blocks(block2);
+      for(uint32_t i1 = 0; i1 < data_blocks; i1++){
+        read_block((*block2).contents.inode.data_blocks[i1], buffer3 + (size_t) i1 * BLOCK_SIZE);
+      }
+      //O_NOFOLLOW so a symbolic link already sitting at path is not written through
+      int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW, 0644);
+      FILE *host_file = fd < 0 ? NULL : fdopen(fd, "wb");
+      if(host_file == NULL){
+        if(fd >= 0){
+          close(fd);
+        }
+        ret = -1;
+      }else{
+        if(fwrite(buffer3, 1, file_size, host_file) != file_size){
+          ret = -1;
+        }
+        if(fclose(host_file) != 0){
+          ret = -1;
+        }
+        //only files that made it to the host completely are counted
+        if(ret == E_SUCCESS){
+          stats->files += 1;
+          stats->bytes += file_size;
+        }
+      }
+    }
+    free(path);
+  }
+  free(buffer1);
+  free(buffer2);
+  return ret;
+}
+
+
+/* jfs_import
+ *   copies a directory tree from the _real_ file system into the current
+ *   directory: every subdirectory of host_path becomes a subdirectory and every
+ *   regular file becomes a file with the same contents (symbolic links and other
+ *   kinds of host files are skipped).  The host tree is scanned first and
+ *   checked against the current directory, so names that are too long or
+ *   already exist, directories that would get too many entries and files that
+ *   are too big are reported before anything is written.  Then IMPORT_READERS threads
+ *   read the host files ahead (up to IMPORT_QUEUE_DEPTH files, each with a
+ *   single call) while the calling thread, the only one using the disk layer,
+ *   allocates each file's inode and data blocks together, writes every block
+ *   once and writes each dir node once after all its entries are added.
+ * host_path - path of the directory on the _real_ file system to copy in
+ * stats - if not NULL, filled in with the number of files, directories and
+ *   bytes copied and the time it took
+ * returns 0 on success, -1 if a host file or directory could not be read or
+ *   memory could not be allocated, or one of the following error codes on
+ *   failure: E_EXISTS, E_MAX_NAME_LENGTH, E_MAX_DIR_ENTRIES, E_MAX_FILE_SIZE,
+ *   E_DISK_FULL (only E_DISK_FULL and host read errors can happen after the
+ *   copy started; everything copied in before them is kept)
+ */
+int jfs_import(const char* host_path, struct jfs_transfer_stats* stats) {
+  struct jfs_transfer_stats counters = {0, 0, 0, 0};
+  double start = now_seconds();
+  struct import_plan plan = {NULL, 0, 0, NULL, 0};
+  uint32_t first = 0;
+  uint32_t count = 0;
+  int ret = plan_dir(&plan, host_path, &first, &count);
+  if(ret == E_SUCCESS){
+    ret = plan_check_target(&plan, jfs_current_dir(), first, count);
+  }
+  if(ret == E_SUCCESS){
+    //number the files in plan order, which is the order write_dir uses them in
+    plan.files = malloc((plan.num_items + 1) * sizeof(uint32_t));
+    if(plan.files == NULL){
+      ret = -1;
+    }else{
+      for(uint32_t i = 0; i < plan.num_items; i++){
+        if(!plan.items[i].is_dir){
+          plan.items[i].file_index = plan.num_files;
+          plan.files[plan.num_files] = i;
+          plan.num_files += 1;
+        }
+      }
+    }
+  }
+  if(ret == E_SUCCESS){
+    struct import_queue queue;
+    memset(&queue, 0, sizeof(queue));
+    queue.plan = &plan;
+    pthread_mutex_init(&queue.lock, NULL);
+    pthread_cond_init(&queue.changed, NULL);
+    for(int s = 0; s < IMPORT_QUEUE_DEPTH; s++){
+      queue.slots[s] = malloc((size_t) MAX_DATA_BLOCKS * BLOCK_SIZE);
+      if(queue.slots[s] == NULL){
+        ret = -1;
+      }
+    }
+    pthread_t readers[IMPORT_READERS];
+    int num_readers = 0;
+    while(ret == E_SUCCESS && num_readers < IMPORT_READERS &&
+          pthread_create(&readers[num_readers], NULL, import_reader, &queue) == 0){
+      num_readers += 1;
+    }
+    if(num_readers == 0){
+      ret = -1;
+    }
+    if(ret == E_SUCCESS){
+      ret = write_dir(&plan, &queue, jfs_current_dir(), first, count, &counters);
+    }
+    //after an error the readers may still be waiting for slots, so tell them to stop
+    pthread_mutex_lock(&queue.lock);
+    queue.stop = TRUE;
+    pthread_cond_broadcast(&queue.changed);
+    pthread_mutex_unlock(&queue.lock);
+    for(int r = 0; r < num_readers; r++){
+      pthread_join(readers[r], NULL);
+    }
+    for(int s = 0; s < IMPORT_QUEUE_DEPTH; s++){
+      free(queue.slots[s]);
+    }
+    pthread_mutex_destroy(&queue.lock);
+    pthread_cond_destroy(&queue.changed);
+  }
+  plan_free(&plan);
+  counters.seconds = now_seconds() - start;
+  if(stats != NULL){
+    *stats = counters;
+  }
+  return ret;
+}
+
+
+/* jfs_export
+ *   copies the current directory and everything below it out to the _real_
+ *   file system under host_path, which is created if it does not exist yet.
+ *   Each file is read block by block into one buffer and written to the host
+ *   with a single call; files and directories are never created through a
+ *   symbolic link already present below host_path.  Everything read from the image is checked first (names
+ *   that are not plain host file names, block numbers out of range, unknown
+ *   block types, file sizes over MAX_FILE_SIZE, directory cycles); the export
+ *   stops at the first such problem and reports it on stderr.
+ * host_path - path of the directory on the _real_ file system to copy out to
+ * stats - if not NULL, filled in with the number of files, directories and
+ *   bytes written and the time it took
+ * returns 0 on success or -1 if the image is damaged, memory could not be
+ *   allocated, or a host file or directory could not be written
+ */
+int jfs_export(const char* host_path, struct jfs_transfer_stats* stats) {
+  struct jfs_transfer_stats counters = {0, 0, 0, 0};
+  double start = now_seconds();
+  int ret = -1;
+  //one buffer big enough for the largest possible file, shared by the whole export
+  char *buffer3 = malloc((size_t) MAX_DATA_BLOCKS * BLOCK_SIZE);
+  unsigned char *visited = calloc(NUM_BLOCKS, 1);
+  //host_path itself is the caller's choice, so unlike the directories below it, it may be a symbolic link
+  if(buffer3 != NULL && visited != NULL && (mkdir(host_path, 0755) == 0 || errno == EEXIST)){
+    block_num_t dir = jfs_current_dir();
+    visited[dir] = TRUE;
+    ret = export_dir(dir, host_path, buffer3, visited, &counters);
+  }
+  free(buffer3);
+  free(visited);
+  counters.seconds = now_seconds() - start;
+  if(stats != NULL){
+    *stats = counters;
+  }
+  return ret;
+}
@@ -1,16 +1,20 @@
 #include "jumbo_file_system.h"
+#include "jfs_tools.h"
+#include "jfs_internal.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
-// C does not have a bool type, so I created one that you can use
-typedef char bool_t;
-#define TRUE 1
-#define FALSE 0
 
 
 static block_num_t current_dir;
 
 
+// gives the current directory to the tools in the other files (see jfs_internal.h)
+block_num_t jfs_current_dir() {
+  return current_dir;
+}
+
+
 // optional helper function you can implement to tell you if a block is a dir node or an inode
 static bool_t is_dir(block_num_t block_num) {
   //to check if a block is a directory or an inode... have to access the is_dir variable block struct
@@ -671,6 +675,265 @@ int jfs_read(const char* file_name, void* buf, unsigned short* ptr_count) {
 }
 
 
+// helper function that gives the block with the given number out of an in-memory copy of the disk
+static struct block *block_at(char *image, block_num_t block_num) {
+  return (struct block *) (image + (size_t) block_num * BLOCK_SIZE);
+}
+
+
+// the checks below are shared by jfs_fsck and jfs_export (see jfs_internal.h); each one
+// reports what it finds on stderr, prefixed with who, and returns the number of problems
+
+int jfs_check_num_entries(const char *who, block_num_t dir, const struct block *block) {
+  if((*block).contents.dirnode.num_entries > MAX_DIR_ENTRIES){
+    fprintf(stderr, "%s: dir %u: num_entries %u exceeds MAX_DIR_ENTRIES\n", who, (unsigned) dir,
+            (unsigned) (*block).contents.dirnode.num_entries);
+    return 1;
+  }
+  return 0;
+}
+
+
+int jfs_check_entry_name(const char *who, block_num_t dir, const struct block *block, int i) {
+  const char *name = (*block).contents.dirnode.entries[i].name;
+  //the name has to be non empty and null terminated within MAX_NAME_LENGTH
+  if(name[0] == '\0' || memchr(name, '\0', MAX_NAME_LENGTH + 1) == NULL){
+    fprintf(stderr, "%s: dir %u: entry %d has an invalid name\n", who, (unsigned) dir, i);
+    return 1;
+  }
+  for(int j = 0; j < i; j++){
+    if(strncmp(name, (*block).contents.dirnode.entries[j].name, MAX_NAME_LENGTH + 1) == 0){
+      fprintf(stderr, "%s: dir %u: duplicate name %s\n", who, (unsigned) dir, name);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+
+int jfs_check_entry_block(const char *who, block_num_t dir, const struct block *block, int i) {
+  block_num_t child = (*block).contents.dirnode.entries[i].block_num;
+  if(child == 0 || child >= NUM_BLOCKS){
+    fprintf(stderr, "%s: dir %u: entry %d points to block %u out of range\n", who, (unsigned) dir, i, (unsigned) child);
+    return 1;
+  }
+  return 0;
+}
+
+
+int jfs_check_block_type(const char *who, block_num_t block_num, const struct block *block) {
+  if((*block).is_dir != 0 && (*block).is_dir != 1){
+    fprintf(stderr, "%s: block %u: unknown block type %u\n", who, (unsigned) block_num, (unsigned) (*block).is_dir);
+    return 1;
+  }
+  return 0;
+}
+
+
+uint32_t jfs_inode_data_blocks(const struct block *block) {
+  uint32_t file_size = (*block).contents.inode.file_size;
+  //the file can never be bigger than the inode can hold
+  if(file_size > MAX_FILE_SIZE){
+    file_size = MAX_FILE_SIZE;
+  }
+  //the number of data blocks in use follows from the file_size, same as in jfs_stat
+  uint32_t data_blocks = file_size / BLOCK_SIZE;
+  if(file_size % BLOCK_SIZE != 0){
+    data_blocks += 1;
+  }
+  return data_blocks;
+}
+
+
+int jfs_check_inode(const char *who, block_num_t file, const struct block *block) {
+  int problems = 0;
+  uint32_t file_size = (*block).contents.inode.file_size;
+  if(file_size > MAX_FILE_SIZE){
+    fprintf(stderr, "%s: inode %u: file_size %u exceeds MAX_FILE_SIZE\n", who, (unsigned) file, (unsigned) file_size);
+    problems += 1;
+  }
+  uint32_t data_blocks = jfs_inode_data_blocks(block);
+  for(uint32_t i = 0; i < data_blocks; i++){
+    block_num_t data = (*block).contents.inode.data_blocks[i];
+    if(data == 0 || data >= NUM_BLOCKS){
+      fprintf(stderr, "%s: inode %u: data block %u out of range\n", who, (unsigned) file, (unsigned) data);
+      problems += 1;
+    }
+  }
+  return problems;
+}
+
+
+// helper function for jfs_fsck that reads the free-space map kept in block 0 by the disk
+// layer, one bit per block (lowest bit first), and tells if the given block is allocated
+static bool_t marked_used(const char *bitmap, uint32_t block_num) {
+  if((bitmap[block_num / 8] >> (block_num % 8)) & 1){
+    return TRUE;
+  }else{
+    return FALSE;
+  }
+}
+
+
+// helper function for jfs_fsck that checks a single inode and marks every one
+// of its data blocks as referenced; returns the number of problems found
+static int fsck_inode(char *image, unsigned char *refs, block_num_t file) {
+  struct block *block1 = block_at(image, file);
+  int problems = jfs_check_inode("jfs_fsck", file, block1);
+  uint32_t data_blocks = jfs_inode_data_blocks(block1);
+  for(uint32_t i = 0; i < data_blocks; i++){
+    block_num_t data = block1->contents.inode.data_blocks[i];
+    //blocks out of range were already reported by jfs_check_inode
+    if(data == 0 || data >= NUM_BLOCKS){
+      continue;
+    }
+    if(refs[data]){
+      fprintf(stderr, "jfs_fsck: inode %u: data block %u is referenced more than once\n", (unsigned) file, (unsigned) data);
+      problems += 1;
+    }else{
+      refs[data] = TRUE;
+    }
+  }
+  return problems;
+}
+
+
+/* jfs_fsck
+ *   checks the consistency of the whole file system: walks the directory tree
+ *   from the root (block 1) and validates every dir node and inode (entry
+ *   counts, names, block ranges, file sizes, blocks referenced more than once)
+ *   and compares the reachable blocks with the free-space map to find orphan
+ *   blocks and referenced blocks that are marked free.  Problems are reported
+ *   on stderr.  The disk is read once, front to back, and everything else is
+ *   done in memory, so a check without rebuild reads at about the sequential
+ *   speed of the DISK file and never writes to it.
+ * rebuild - if nonzero, the free-space map is rebuilt so that exactly the
+ *   blocks reachable from the root are allocated; this costs one
+ *   release_block() per orphan and, if reachable blocks are marked free,
+ *   allocate_block() calls until all of them are claimed back (plus a release
+ *   for every other block handed out meanwhile); a root marked free is only
+ *   reported, since the allocator never hands out block 1; the map is left
+ *   alone if part of the tree could not be walked (the root is not a dir node,
+ *   or an entry points out of range or at a block of unknown type), because
+ *   everything below such an entry would otherwise be released as orphans;
+ *   if zero, the disk is not written at all
+ * returns the number of problems found (0 if the file system is consistent)
+ *   or -1 if memory for the check could not be allocated
+ */
+int jfs_fsck(int rebuild) {
+  //read the whole disk into memory in block order, so the walk below never has to seek
+  char *image = malloc((size_t) NUM_BLOCKS * BLOCK_SIZE);
+  //one mark per block telling if it is reachable from the root
+  unsigned char *refs = calloc(NUM_BLOCKS, 1);
+  //the directories still to be visited; every block is pushed at most once so NUM_BLOCKS is enough
+  block_num_t *stack = malloc(NUM_BLOCKS * sizeof(block_num_t));
+  if(image == NULL || refs == NULL || stack == NULL){
+    free(image);
+    free(refs);
+    free(stack);
+    return -1;
+  }
+  for(uint32_t b = 0; b < NUM_BLOCKS; b++){
+    read_block(b, image + (size_t) b * BLOCK_SIZE);
+  }
+  int problems = 0;
+  int top = 0;
+  //set to FALSE when part of the tree could not be walked, since its blocks would then look like orphans
+  bool_t complete = TRUE;
+  //block 0 holds the free-space map and block 1 is the root directory
+  refs[0] = TRUE;
+  refs[1] = TRUE;
+  if(block_at(image, 1)->is_dir != 0){
+    fprintf(stderr, "jfs_fsck: block 1: root is not a directory\n");
+    problems += 1;
+    complete = FALSE;
+  }else{
+    stack[top++] = 1;
+  }
+  while(top > 0){
+    block_num_t dir = stack[--top];
+    struct block *block1 = block_at(image, dir);
+    uint16_t num_entries1 = (*block1).contents.dirnode.num_entries;
+    if(jfs_check_num_entries("jfs_fsck", dir, block1) != 0){
+      problems += 1;
+      num_entries1 = MAX_DIR_ENTRIES;
+    }
+    for(int i = 0; i < num_entries1; i++){
+      problems += jfs_check_entry_name("jfs_fsck", dir, block1, i);
+      if(jfs_check_entry_block("jfs_fsck", dir, block1, i) != 0){
+        problems += 1;
+        complete = FALSE;
+        continue;
+      }
+      block_num_t child = (*block1).contents.dirnode.entries[i].block_num;
+      //a block that was already reached is never walked again, which also stops cycles
+      if(refs[child]){
+        fprintf(stderr, "jfs_fsck: dir %u: block %u is referenced more than once\n", (unsigned) dir, (unsigned) child);
+        problems += 1;
+        continue;
+      }
+      refs[child] = TRUE;
+      struct block *block2 = block_at(image, child);
+      if(jfs_check_block_type("jfs_fsck", child, block2) != 0){
+        problems += 1;
+        complete = FALSE;
+      }else if((*block2).is_dir == 0){
+        stack[top++] = child;
+      }else{
+        problems += fsck_inode(image, refs, child);
+      }
+    }
+  }
+  //compare what is reachable with the free-space map in block 0, which we already have in memory
+  const char *bitmap = image;
+  int missing = 0;
+  for(uint32_t b = 1; b < NUM_BLOCKS; b++){
+    if(refs[b] && !marked_used(bitmap, b)){
+      fprintf(stderr, "jfs_fsck: block %u is in use but marked free\n", (unsigned) b);
+      problems += 1;
+      //the allocator never hands out the root, so a rebuild cannot claim it back
+      if(b != 1){
+        missing += 1;
+      }
+    }else if(!refs[b] && marked_used(bitmap, b)){
+      fprintf(stderr, "jfs_fsck: block %u is allocated but not reachable (orphan)\n", (unsigned) b);
+      problems += 1;
+    }
+  }
+  //only a rebuild ever calls into the allocator, and only when the whole tree was walked;
+  //otherwise the blocks below the damaged entry would all be released as orphans
+  if(rebuild && !complete){
+    fprintf(stderr, "jfs_fsck: part of the tree could not be walked, free-space map not rebuilt\n");
+  }
+  if(rebuild && complete){
+    //the allocator has no call to take one particular block, so blocks that are in use but
+    //marked free are claimed by allocating until all of them came back; every other block
+    //handed out on the way is collected in the now unused stack and given back below
+    int extras = 0;
+    block_num_t new_block;
+    while(missing > 0 && (new_block = allocate_block()) != 0){
+      if(refs[new_block]){
+        missing -= 1;
+      }else{
+        stack[extras++] = new_block;
+      }
+    }
+    while(extras > 0){
+      extras -= 1;
+      release_block(stack[extras]);
+    }
+    for(uint32_t b = 2; b < NUM_BLOCKS; b++){
+      if(!refs[b] && marked_used(bitmap, b)){
+        release_block(b);
+      }
+    }
+  }
+  free(image);
+  free(refs);
+  free(stack);
+  return problems;
+}
+
 
 /* jfs_unmount
  *   makes the file system no longer accessible (unless it is mounted again).
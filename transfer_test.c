@@ -0,0 +1,264 @@
+/* transfer_test.c
+ *   reproducible check for jfs_import and jfs_export: builds a host tree under
+ *   SCRATCH, imports it, checks the image with jfs_fsck, exports it again and
+ *   compares the two host trees; then checks that E_EXISTS, E_MAX_NAME_LENGTH
+ *   and E_MAX_DIR_ENTRIES are reported before anything is written, and that an
+ *   import running out of space (E_DISK_FULL) leaves a consistent image.
+ * usage: transfer_test DISK SCRATCH   (DISK has to be a freshly formatted disk
+ *   file and SCRATCH a host directory that does not exist yet)
+ * build together with jumbo_file_system.c, jfs_transfer.c and the disk layer,
+ *   linking with -pthread
+ */
+#define _POSIX_C_SOURCE 200809L
+#include "jfs_tools.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+// helper function that prints a failed step and exits
+static void check(int ok, const char *what) {
+  if(!ok){
+    fprintf(stderr, "transfer_test: FAILED: %s\n", what);
+    exit(1);
+  }
+  printf("transfer_test: ok: %s\n", what);
+}
+
+
+// helper function that builds a malloced path out of a directory and a name
+static char *path_of(const char *dir, const char *name) {
+  char *path = malloc(strlen(dir) + strlen(name) + 2);
+  sprintf(path, "%s/%s", dir, name);
+  return path;
+}
+
+
+// helper function that creates a host directory dir/name
+static void make_dir(const char *dir, const char *name) {
+  char *path = path_of(dir, name);
+  check(mkdir(path, 0755) == 0, path);
+  free(path);
+}
+
+
+// helper function that writes a host file dir/name of the given size with contents depending on seed
+static void make_file(const char *dir, const char *name, uint32_t size, int seed) {
+  char *path = path_of(dir, name);
+  FILE *f = fopen(path, "wb");
+  check(f != NULL, path);
+  for(uint32_t i = 0; i < size; i++){
+    fputc((int) ((i * 31 + seed) & 0xff), f);
+  }
+  check(fclose(f) == 0, path);
+  free(path);
+}
+
+
+// helper function that tells if two host files have the same contents
+static int same_file(const char *a, const char *b) {
+  FILE *fa = fopen(a, "rb");
+  FILE *fb = fopen(b, "rb");
+  int same = fa != NULL && fb != NULL;
+  while(same){
+    int ca = fgetc(fa);
+    int cb = fgetc(fb);
+    if(ca != cb){
+      same = 0;
+    }
+    if(ca == EOF){
+      break;
+    }
+  }
+  if(fa != NULL){
+    fclose(fa);
+  }
+  if(fb != NULL){
+    fclose(fb);
+  }
+  return same;
+}
+
+
+// helper function that tells if the host tree b holds exactly the directories and regular
+// files of the host tree a (symbolic links in a are skipped, as jfs_import does)
+static int same_tree(const char *a, const char *b) {
+  DIR *dir = opendir(a);
+  if(dir == NULL){
+    return 0;
+  }
+  int same = 1;
+  int count_a = 0;
+  struct dirent *entry;
+  while(same && (entry = readdir(dir)) != NULL){
+    if(strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0){
+      continue;
+    }
+    char *pa = path_of(a, entry->d_name);
+    char *pb = path_of(b, entry->d_name);
+    struct stat sa;
+    struct stat sb;
+    if(lstat(pa, &sa) == 0 && !S_ISLNK(sa.st_mode)){
+      count_a += 1;
+      if(lstat(pb, &sb) != 0 || S_ISDIR(sa.st_mode) != S_ISDIR(sb.st_mode)){
+        same = 0;
+      }else if(S_ISDIR(sa.st_mode)){
+        same = same_tree(pa, pb);
+      }else{
+        same = same_file(pa, pb);
+      }
+    }
+    free(pa);
+    free(pb);
+  }
+  closedir(dir);
+  //b must not hold anything more than a
+  int count_b = 0;
+  dir = opendir(b);
+  if(dir == NULL){
+    return 0;
+  }
+  while((entry = readdir(dir)) != NULL){
+    if(strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0){
+      count_b += 1;
+    }
+  }
+  closedir(dir);
+  return same && count_a == count_b;
+}
+
+
+// helper function that gives the number of entries in the current directory of the image
+static int count_entries() {
+  char *directories[MAX_DIR_ENTRIES + 1];
+  char *files[MAX_DIR_ENTRIES + 1];
+  jfs_ls(directories, files);
+  int count = 0;
+  for(int i = 0; directories[i] != NULL; i++){
+    free(directories[i]);
+    count += 1;
+  }
+  for(int i = 0; files[i] != NULL; i++){
+    free(files[i]);
+    count += 1;
+  }
+  return count;
+}
+
+
+int main(int argc, char **argv) {
+  if(argc != 3){
+    fprintf(stderr, "usage: %s DISK SCRATCH\n", argv[0]);
+    return 2;
+  }
+  const char *scratch = argv[2];
+  check(mkdir(scratch, 0755) == 0, "create the scratch directory");
+  char name[MAX_NAME_LENGTH + 2];
+
+  //the tree for the round trip: empty, partial, exact and largest files, nested and empty
+  //directories, and a symbolic link that the import skips
+  char *src = path_of(scratch, "src");
+  check(mkdir(src, 0755) == 0, "create src");
+  make_file(src, "empty", 0, 1);
+  make_file(src, "small", 1, 2);
+  make_file(src, "block", BLOCK_SIZE, 3);
+  make_file(src, "partial", 3 * BLOCK_SIZE + 7, 4);
+  make_file(src, "largest", MAX_FILE_SIZE, 5);
+  make_dir(src, "sub");
+  char *sub = path_of(src, "sub");
+  make_file(sub, "inner", 2 * BLOCK_SIZE, 6);
+  make_dir(sub, "nothing");
+  free(sub);
+  char *symbolic = path_of(src, "link");
+  check(symlink("small", symbolic) == 0, "create a symbolic link");
+  free(symbolic);
+
+  check(jfs_mount(argv[1]) == 0, "mount");
+  struct jfs_transfer_stats stats;
+  check(jfs_import(src, &stats) == E_SUCCESS, "import src");
+  check(stats.files == 6 && stats.dirs == 2, "import counts 6 files and 2 dirs");
+  check(jfs_fsck(0) == 0, "fsck after the import finds nothing");
+  char *out = path_of(scratch, "out");
+  check(jfs_export(out, &stats) == E_SUCCESS, "export to out");
+  check(stats.files == 6 && stats.dirs == 2, "export counts 6 files and 2 dirs");
+  check(same_tree(src, out), "the exported tree is the same as the imported one");
+  free(out);
+
+  //importing the same tree again clashes with the entries already there, and nothing is written
+  int before = count_entries();
+  check(jfs_import(src, NULL) == E_EXISTS, "importing src again gives E_EXISTS");
+  check(count_entries() == before, "E_EXISTS left the directory alone");
+  check(jfs_fsck(0) == 0, "fsck after E_EXISTS finds nothing");
+  free(src);
+
+  //the error cases below run in a directory of their own
+  check(jfs_mkdir("errors") == E_SUCCESS, "mkdir errors");
+  check(jfs_chdir("errors") == E_SUCCESS, "chdir errors");
+
+  //a host name that is one character too long, next to a file that would fit
+  char *longname = path_of(scratch, "longname");
+  check(mkdir(longname, 0755) == 0, "create longname");
+  make_file(longname, "fine", 10, 7);
+  memset(name, 'n', MAX_NAME_LENGTH + 1);
+  name[MAX_NAME_LENGTH + 1] = '\0';
+  make_file(longname, name, 10, 8);
+  check(jfs_import(longname, NULL) == E_MAX_NAME_LENGTH, "a name that is too long gives E_MAX_NAME_LENGTH");
+  check(count_entries() == 0, "E_MAX_NAME_LENGTH wrote nothing");
+  free(longname);
+
+  //a host directory with one entry more than a dir node can hold
+  char *many = path_of(scratch, "many");
+  check(mkdir(many, 0755) == 0, "create many");
+  for(int i = 0; i < (int) MAX_DIR_ENTRIES + 1; i++){
+    sprintf(name, "f%d", i);
+    make_file(many, name, 1, i);
+  }
+  check(jfs_import(many, NULL) == E_MAX_DIR_ENTRIES, "too many entries gives E_MAX_DIR_ENTRIES");
+  check(count_entries() == 0, "E_MAX_DIR_ENTRIES wrote nothing");
+  free(many);
+
+  //a target directory with room for one more entry and a host tree with two
+  for(int i = 0; i < (int) MAX_DIR_ENTRIES - 1; i++){
+    sprintf(name, "e%d", i);
+    check(jfs_creat(name) == E_SUCCESS, "fill the target directory");
+  }
+  char *two = path_of(scratch, "two");
+  check(mkdir(two, 0755) == 0, "create two");
+  make_file(two, "x", 1, 9);
+  make_file(two, "y", 1, 10);
+  check(jfs_import(two, NULL) == E_MAX_DIR_ENTRIES, "overflowing the target directory gives E_MAX_DIR_ENTRIES");
+  check(count_entries() == (int) MAX_DIR_ENTRIES - 1, "overflowing the target directory wrote nothing");
+  check(jfs_fsck(0) == 0, "fsck after the rejected imports finds nothing");
+  free(two);
+
+  //more data than the disk can hold: largest possible files spread over subdirectories,
+  //all hard links to one host file so the scratch directory stays small
+  check(jfs_chdir(NULL) == E_SUCCESS, "chdir to the root");
+  check(jfs_mkdir("full") == E_SUCCESS, "mkdir full");
+  check(jfs_chdir("full") == E_SUCCESS, "chdir full");
+  char *full = path_of(scratch, "full");
+  check(mkdir(full, 0755) == 0, "create full");
+  make_file(scratch, "largest", MAX_FILE_SIZE, 11);
+  char *largest = path_of(scratch, "largest");
+  int needed = NUM_BLOCKS / (MAX_DATA_BLOCKS + 1) + 2;
+  for(int i = 0; i < needed; i++){
+    sprintf(name, "d%d", (int) (i / MAX_DIR_ENTRIES));
+    char *dir = path_of(full, name);
+    mkdir(dir, 0755);
+    sprintf(name, "f%d", i);
+    char *file = path_of(dir, name);
+    check(link(largest, file) == 0, file);
+    free(file);
+    free(dir);
+  }
+  check(jfs_import(full, &stats) == E_DISK_FULL, "running out of space gives E_DISK_FULL");
+  check(stats.files > 0, "the files imported before E_DISK_FULL are kept");
+  check(jfs_fsck(0) == 0, "fsck after E_DISK_FULL finds nothing");
+  free(largest);
+  free(full);
+  check(jfs_unmount() == 0, "unmount");
+  return 0;
+}